@@ -13,9 +13,39 @@
  * It is acceptable to directly manipulate the `Expect::errors()` (e.g. to reset
  * it or decrement it as needs dictate..
  *
+ * Copy/move budgets check `Noisy` (noisy2.hpp) counters from the point of the
+ * macro to the end of the enclosing scope:
+ *
+ * Macro                   | Expects within the rest of the scope
+ * -----                   | ------------------------------------
+ * `EXPECT_MAX_COPIES(n)`  | at most n copies
+ * `EXPECT_NO_COPIES()`    | no copies at all (e.g. RVO/NRVO worked)
+ * `EXPECT_MAX_MOVES(n)`   | at most n moves
+ * `EXPECT_MOVES(n)`       | exactly n moves
+ *
+ * Any class providing `T::counts().copies` and `T::counts().moves` may be
+ * checked directly with `Expect::Budget<T>`.
+ *
+ * `EXPECT_HOT( expression );` is for tight loops. The passing path is a single
+ * compare-and-branch: it neither counts checks nor touches `Expect::passed()`.
+ * A failure appends a compact record (expression/file/line id plus a repeat
+ * count) to a per-thread buffer, which `Expect::summary()` (or an explicit
+ * `Expect::hot_flush()`) formats and adds to `Expect::errors()` once the
+ * worker threads have finished.
  */
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <string>
+#include <vector>
+
+#if defined( __GNUC__ ) || defined( __clang__ )
+#  define EXPECT_UNLIKELY(cond) __builtin_expect( !!(cond), 0 )
+#  define EXPECT_COLD [[gnu::cold, gnu::noinline]]
+#else
+#  define EXPECT_UNLIKELY(cond) (cond)
+#  define EXPECT_COLD
+#endif
 
 namespace Expect
 {
@@ -37,8 +67,69 @@ namespace Expect
     std::cerr << std::endl;
   }
 
+  //----------------------------------------------------------------------------
+  // Deferred failures for EXPECT_HOT
+  struct Hot_site   { const char* expr; const char* file; int line; };
+  struct Hot_record { const Hot_site* site; size_t count; };
+  using  Hot_records = std::vector<Hot_record>;
+
+  [[maybe_unused]] static std::mutex&               hot_guard()   { static std::mutex m; return m; }
+  [[maybe_unused]] static std::vector<Hot_records*>& hot_buffers() { static std::vector<Hot_records*> live; return live; }
+  [[maybe_unused]] static Hot_records&              hot_retired() { static Hot_records records; return records; }
+
+  // Registers each thread's records so they can be collected (or kept after the thread exits)
+  struct Hot_buffer
+  {
+    Hot_records records;
+    Hot_buffer()  { std::lock_guard<std::mutex> lock{ hot_guard() }; hot_buffers().push_back( &records ); }
+    ~Hot_buffer()
+    {
+      std::lock_guard<std::mutex> lock{ hot_guard() };
+      hot_retired().insert( hot_retired().end(), records.begin(), records.end() );
+      auto& live = hot_buffers();
+      for( auto it = live.begin(); it != live.end(); ++it ) {
+        if( *it == &records ) { live.erase( it ); break; }
+      }
+    }
+    Hot_buffer( const Hot_buffer& ) = delete;
+    Hot_buffer& operator=( const Hot_buffer& ) = delete;
+  };
+
+  EXPECT_COLD [[maybe_unused]] static void hot_failure( const Hot_site& site )
+  {
+    thread_local Hot_buffer buffer;
+    auto& records = buffer.records;
+    if( not records.empty() and records.back().site == &site ) ++records.back().count;
+    else records.push_back( { &site, 1u } );
+  }
+
+  // Report and count deferred failures; returns the number of failures drained.
+  // Call only while no thread is executing EXPECT_HOT.
+  [[maybe_unused]] static size_t hot_flush()
+  {
+    std::map<const Hot_site*,size_t> failures;
+    {
+      std::lock_guard<std::mutex> lock{ hot_guard() };
+      auto drain = [&failures]( Hot_records& records ) {
+        for( const auto& record : records ) failures[ record.site ] += record.count;
+        records.clear();
+      };
+      for( auto* records : hot_buffers() ) drain( *records );
+      drain( hot_retired() );
+    }
+    size_t total = 0;
+    for( const auto& [ site, count ] : failures ) {
+      Expect::error( std::string("unexpected ") + site->expr + " (" + std::to_string( count ) + " times)",
+                     site->file, site->line );
+      Expect::errors() += count - 1;
+      total += count;
+    }
+    return total;
+  }
+
   [[maybe_unused]] static int summary(const std::string& prefix="")
   {
+    Expect::hot_flush();
     std::cout << Expect::checks() << " checks performed." << std::endl;
     std::cout << Expect::errors() << " errors detected." << std::endl;
     if( not prefix.empty()  ) std::cout << prefix << " ";
@@ -46,6 +137,43 @@ namespace Expect
     else                      std::cout << "FAIL" << std::endl;
     return (Expect::errors() == 0)?0:1;
   }
+
+  //----------------------------------------------------------------------------
+  // Scope guard that checks the change in copy or move counts on destruction
+  template<class Counted>
+  class Budget
+  {
+  public:
+    enum Kind    { Copies, Moves };
+    enum Compare { AtMost, Exactly };
+    Budget( Kind kind, Compare compare, size_t limit, const char* file, int line )
+    : m_kind( kind ), m_compare( compare ), m_limit( limit )
+    , m_start( current() ), m_file( file ), m_line( line )
+    {
+    }
+    ~Budget()
+    {
+      ++Expect::checks();
+      auto used = current() - m_start;
+      Expect::passed() = ( m_compare == AtMost ) ? used <= m_limit : used == m_limit;
+      if( not Expect::passed() ) {
+        Expect::error( std::string( "budget #" ) + " expected "
+                     + ( m_compare == AtMost ? "at most " : "exactly " )
+                     + std::to_string( m_limit ) + ( m_kind == Copies ? " copies" : " moves" )
+                     + " but saw " + std::to_string( used ), m_file, m_line );
+      }
+    }
+    Budget( const Budget& ) = delete;
+    Budget& operator=( const Budget& ) = delete;
+  private:
+    size_t current() const { return ( m_kind == Copies ) ? Counted::counts().copies : Counted::counts().moves; }
+    Kind        m_kind;
+    Compare     m_compare;
+    size_t      m_limit;
+    size_t      m_start;
+    const char* m_file;
+    int         m_line;
+  };
 }
 
 #define EXPECT(expr) do { \
@@ -54,4 +182,21 @@ namespace Expect
     Expect::error( std::string("unexpected ")+ #expr, __FILE__, __LINE__ ); \
 } while(0)
 
+#define EXPECT_HOT(expr) do { \
+  if ( EXPECT_UNLIKELY( not (expr) ) ) { \
+    static constexpr Expect::Hot_site expect_hot_site{ #expr, __FILE__, __LINE__ }; \
+    Expect::hot_failure( expect_hot_site ); \
+  } \
+} while(0)
+
+#define EXPECT_CONCAT_(a,b) a##b
+#define EXPECT_CONCAT(a,b)  EXPECT_CONCAT_(a,b)
+#define EXPECT_BUDGET(kind,compare,n) \
+  Expect::Budget<Noisy> EXPECT_CONCAT(expect_budget_,__LINE__) \
+  { Expect::Budget<Noisy>::kind, Expect::Budget<Noisy>::compare, size_t(n), __FILE__, __LINE__ }
+#define EXPECT_MAX_COPIES(n) EXPECT_BUDGET(Copies,AtMost,n)
+#define EXPECT_NO_COPIES()   EXPECT_BUDGET(Copies,AtMost,0)
+#define EXPECT_MAX_MOVES(n)  EXPECT_BUDGET(Moves,AtMost,n)
+#define EXPECT_MOVES(n)      EXPECT_BUDGET(Moves,Exactly,n)
+
 //TAF! vim:nospell
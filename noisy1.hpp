@@ -7,6 +7,7 @@
 #include <string>
 #include <sstream>
 #include <iostream>
+#include <iomanip>
 
 class Noisy {
 public:
@@ -53,10 +54,10 @@ private:
   Str     m_label{};
   //............................................................................
   void noise( const Str& alt = "" ) const noexcept {
+    std::cout << "Noisy{ " << this << ": ";
+    if( m_label.find_first_of( " \t\"\\" ) != Str::npos ) std::cout << std::quoted( m_label ) << ' ';
+    else std::cout << ( m_label.empty() ? "<<empty>>" : m_label ) << ' ';
     std::cout
-      << "Noisy{ "
-      <<   this << ": "
-      <<   ( m_label.empty() ? "<<empty>>" : m_label ) << ' '
       <<   ( alt.empty() ? state() : alt ) << ' '
       << "}"
       << std::endl;
@@ -9,6 +9,20 @@
  * Notice that it uses UniqueId to ensure that movements are tracked. Output
  * includes the address of the original object to aid debug when segfaults
  * from other causes occur. This class was designed to not throw.
+ *
+ * Every event is also tallied per label. Call `Noisy::report()` at the end of
+ * a run to emit lines of the form `Noisy-count <label> <event> <count>`, which
+ * `noisydiff` can compare against a report from another build. Labels that
+ * contain whitespace or quotes are written with `std::quoted` so reports and
+ * traces remain parseable.
+ *
+ * Objects are also followed across threads via their UniqueId. When a value
+ * ends (destruction, or being overwritten by assignment) its thread path
+ * (constructing thread, threads that moved or copied it, final thread) is
+ * recorded per label. Move-construction and move-assignment carry the path
+ * along, and
+ * `Noisy::migration_report()` shows the fraction of objects that migrated, the
+ * most common thread-to-thread paths and a histogram of migration counts.
  */
 
 #include <sstream>
@@ -18,14 +32,18 @@
 #include <cstdint>
 #include <string_view>
 #include <iostream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include "noisy_events.hpp"
 #include "uniqueid.hpp"
 
-class Noisy
+class Noisy: public Noisy_events
 {
 public:
   using Str = std::string;
-  enum [[maybe_unused]] State_t { Reset, DfltCtor, ExplCtor, Dtor, CpCtor, 
-                                  MvCtor, CpAsgn, MvAsgn, MvFrom, CpSelf, MvSelf };
   //----------------------------------------------------------------------------
   // Constructors and other special members
   UniqueId<Noisy> id{"Noisy"};
@@ -47,6 +65,8 @@ public:
   {
     m_state = Dtor;
     noise();
+    std::lock_guard<std::mutex> lock{ guard() };
+    record_path();
   }
   //............................................................................
   Noisy( const Noisy& rhs )                //< copyi constructor
@@ -54,12 +74,22 @@ public:
   , m_label( rhs.m_label )
   {
     m_v = rhs.m_v+uint8_t( 1 );
+    {
+      std::lock_guard<std::mutex> lock{ guard() };
+      if( not rhs.id.threads().empty() ) rhs.id.touch(); //< husks have no path to extend
+    }
     noise();
   }
   //............................................................................
   Noisy& operator=( const Noisy& rhs )     //< copy-assign
   {
     if( this != &rhs ) {
+      {
+        std::lock_guard<std::mutex> lock{ guard() };
+        record_path(); //< previous value ends here
+        id.restart_threads();
+        if( not rhs.id.threads().empty() ) rhs.id.touch();
+      }
       m_state = CpAsgn;
       m_label = rhs.m_label;
       ++m_v;
@@ -84,7 +114,13 @@ public:
   Noisy& operator=( Noisy&& rhs ) noexcept //< move-assign
   {
     if( this != &rhs ) {
+      {
+        std::lock_guard<std::mutex> lock{ guard() };
+        record_path();            //< previous value ends here
+        id.take_threads( rhs.id ); //< rhs's value continues here; rhs becomes a husk
+      }
       m_state = MvAsgn;
+      rhs.m_state = MvFrom;
       m_label = std::exchange( rhs.m_label,std::string{} );
       m_v = std::exchange( rhs.m_v, rhs.m_v - ' ' );
       ++m_v;
@@ -124,23 +160,56 @@ public:
   [[maybe_unused, nodiscard]] Str  get ()  const noexcept { noise( "get" ); return m_label; }
   [[maybe_unused, nodiscard]] bool valid() const { return id.valid(); }
   //............................................................................
-  [[maybe_unused, nodiscard]] Str  state() const {
-    switch( m_state ) {
-      case Reset:    return "reset";
-      case DfltCtor: return "default-constructed";
-      case ExplCtor: return "explict-constructed";
-      case Dtor:     return "deconstructed";
-      case CpCtor:   return "copy-constructed";
-      case MvCtor:   return "move-constructed";
-      case CpAsgn:   return "copy-assigned";
-      case MvAsgn:   return "move-assigned";
-      case MvFrom:   return "moved-from";
-      case CpSelf:   return "copied-self!";
-      case MvSelf:   return "moved-self!";
+  [[maybe_unused, nodiscard]] Str  state() const { return event_name( m_state ); }
+  //............................................................................
+  [[maybe_unused]]            void info() const noexcept { noise( "", false ); }
+  //............................................................................
+  // Event tallies keyed by { label, event }
+  using Tally = std::map<std::pair<Str,Str>,size_t>;
+  static Tally& tally() { static Tally counts; return counts; }
+  //............................................................................
+  // Running totals across all labels (see EXPECT_MAX_COPIES in expect.hpp)
+  static Counts& counts() { static Counts totals; return totals; }
+  //............................................................................
+  [[maybe_unused]] static void report( std::ostream& os = std::cout )
+  {
+    std::lock_guard<std::mutex> lock{ guard() };
+    for( const auto& [ key, count ] : tally() ) {
+      os << "Noisy-count " << quote( key.first ) << ' ' << key.second << ' ' << count << '\n';
     }
+    os << std::flush;
   }
   //............................................................................
-  [[maybe_unused]]            void info() const noexcept { noise(); }
+  // Cross-thread migration statistics keyed by label
+  struct Migration {
+    size_t objects{0};
+    size_t migrated{0};
+    std::map<Str,size_t>    paths{};     //< e.g. "T0->T1" for migrated objects
+    std::map<size_t,size_t> histogram{}; //< migrations per object -> objects
+  };
+  static std::map<Str,Migration>& migrations() { static std::map<Str,Migration> stats; return stats; }
+  //............................................................................
+  [[maybe_unused]] static void migration_report( std::ostream& os = std::cout, size_t top = 5 )
+  {
+    std::lock_guard<std::mutex> lock{ guard() };
+    for( const auto& [ label, m ] : migrations() ) {
+      os << "Noisy-migration " << quote( label ) << ": " << m.objects << " objects, " << m.migrated << " migrated ("
+         << std::fixed << std::setprecision( 1 ) << 100.0 * double( m.migrated ) / double( m.objects )
+         << std::defaultfloat << "%)\n";
+      std::vector<std::pair<Str,size_t>> paths( m.paths.begin(), m.paths.end() );
+      std::stable_sort( paths.begin(), paths.end(), []( const auto& lhs, const auto& rhs ) {
+        return lhs.second > rhs.second;
+      } );
+      if( paths.size() > top ) paths.resize( top );
+      for( const auto& [ path, count ] : paths ) {
+        os << "  path " << std::setw( 8 ) << count << "  " << path << '\n';
+      }
+      for( const auto& [ hops, count ] : m.histogram ) {
+        os << "  hops " << std::setw( 8 ) << count << "  " << hops << " migration" << ( hops == 1 ? "" : "s" ) << '\n';
+      }
+    }
+    os << std::flush;
+  }
   //............................................................................
   explicit operator std::string() const {
     static std::ostringstream os;
@@ -156,17 +225,49 @@ public:
 
 //------------------------------------------------------------------------------
 private:
+  static std::mutex& guard() { static std::mutex m; return m; }
+  //............................................................................
+  // Short, stable names (T0, T1, ...) in order of first appearance
+  static Str thread_name( size_t thread ) { //< UniqueId_base::this_thread() serial
+    static std::map<size_t,size_t> names;
+    auto it = names.emplace( thread, names.size() ).first;
+    return "T" + std::to_string( it->second );
+  }
+  //............................................................................
+  // Record the thread path of a value that is ending here (caller holds guard())
+  void record_path() const noexcept {
+    if( id.threads().empty() ) return; //< husk: its value was moved elsewhere
+    id.touch();
+    const auto& threads = id.threads();
+    auto& m = migrations()[ m_label.empty() ? "<<empty>>" : m_label ];
+    size_t hops = threads.size() - 1;
+    ++m.objects;
+    ++m.histogram[ hops ];
+    if( hops == 0 ) return;
+    ++m.migrated;
+    Str path;
+    for( auto thread : threads ) path += ( path.empty() ? "" : "->" ) + thread_name( thread );
+    ++m.paths[ path ];
+  }
+  //............................................................................
   mutable State_t m_state{};
   Str     m_label{"Noisy"};
   uint8_t m_v{'a'-1}; //< this violates guidelines, but is used to improve visibility of operations
   // Display information useful to debug in a consistent format
-  void noise( const Str& alt="" ) const noexcept {
+  void noise( const Str& alt="", bool count=true ) const noexcept {
+    const Str label{ m_label.empty() ? "<<empty>>" : m_label };
+    const Str event{ alt.empty() ? state() : alt };
+    std::lock_guard<std::mutex> lock{ guard() };
+    if( count ) {
+      ++tally()[ { label, event } ];
+      if( alt.empty() ) tick( counts(), m_state );
+    }
     std::cout
       << "Noisy{ "
       <<   this << ": "
-      <<   ( m_label.empty() ? "<<empty>>" : m_label ) << ' '
+      <<   quote( label ) << ' '
       <<   std::to_string( id( false ) ) << char( m_v ) << ' '
-      <<   ( alt.empty() ? state() : alt ) << ' '
+      <<   event << ' '
       << "}"
       << std::endl;
   }
@@ -0,0 +1,64 @@
+#pragma once
+
+/** @brief Event vocabulary and running totals shared by `Noisy` and `Tracked<T>`
+ *
+ * Both noisy2.hpp and tracked.hpp derive from `Noisy_events`, so their reports
+ * use identical event names and `noisydiff` can line them up. `Counts` (or
+ * `Atomic_counts` for lock-free users) is the shape `Expect::Budget<T>` and
+ * `PROBE_COUNTS` read through `T::counts()`.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+struct Noisy_events
+{
+  enum [[maybe_unused]] State_t { Reset, DfltCtor, ExplCtor, Dtor, CpCtor,
+                                  MvCtor, CpAsgn, MvAsgn, MvFrom, CpSelf, MvSelf, States_max };
+  struct Counts        { size_t constructions{0}, destructions{0}, copies{0}, moves{0}; };
+  struct Atomic_counts { std::atomic<size_t> constructions{0}, destructions{0}, copies{0}, moves{0}; };
+  //............................................................................
+  static const char* event_name( State_t state ) noexcept {
+    switch( state ) {
+      case Reset:    return "reset";
+      case DfltCtor: return "default-constructed";
+      case ExplCtor: return "explict-constructed";
+      case Dtor:     return "deconstructed";
+      case CpCtor:   return "copy-constructed";
+      case MvCtor:   return "move-constructed";
+      case CpAsgn:   return "copy-assigned";
+      case MvAsgn:   return "move-assigned";
+      case MvFrom:   return "moved-from";
+      case CpSelf:   return "copied-self!";
+      case MvSelf:   return "moved-self!";
+      default:       return "?";
+    }
+  }
+  //............................................................................
+  // Update running totals for an event
+  template<class Totals>
+  static void tick( Totals& totals, State_t state ) noexcept {
+    switch( state ) {
+      case DfltCtor: case ExplCtor: ++totals.constructions;                 break;
+      case CpCtor:                  ++totals.constructions; ++totals.copies; break;
+      case MvCtor:                  ++totals.constructions; ++totals.moves;  break;
+      case CpAsgn:                  ++totals.copies;                        break;
+      case MvAsgn:                  ++totals.moves;                         break;
+      case Dtor:                    ++totals.destructions;                  break;
+      default:                                                              break;
+    }
+  }
+  //............................................................................
+  // Quote labels only when needed to keep reports and traces parseable
+  static std::string quote( const std::string& label ) {
+    if( label.find_first_of( " \t\"\\" ) == std::string::npos ) return label;
+    std::ostringstream os;
+    os << std::quoted( label );
+    return os.str();
+  }
+};
+
+//TAF! vim:nospell
@@ -0,0 +1,233 @@
+/** @brief Compare two Noisy count reports or traces
+ *
+ * Usage: `noisydiff [options] BEFORE AFTER`
+ *
+ * Each input may be a count report produced by `Noisy::report()` (lines of the
+ * form `Noisy-count <label> <event> <count>`), a raw trace of `Noisy{ ... }`
+ * lines as printed by `noisy1.hpp` or `noisy2.hpp`, or the output of a self-test
+ * that contains both (the trace is then preferred since it carries call sites).
+ * Labels containing whitespace or quotes are written quoted (see `std::quoted`)
+ * by Noisy and are read back the same way.
+ * When a trace contains the `NNN: statement` lines written by `DO(...)` and
+ * `ECHO(...)`, subsequent events are attributed to that line as their call
+ * site until the next such line appears.
+ *
+ * Output is two tables ranked by absolute change:
+ *   1. per label: constructions, destructions, copies, moves and allocations
+ *   2. per call site, label and raw event
+ *
+ * The pass/fail gate compares per-label event totals, ignoring call sites, so
+ * edits that merely move code to other lines do not fail it.
+ *
+ * Option            | Description
+ * ------            | -----------
+ * `--fail-on=MODE`  | `increase` (default) fails if any count grew, `any` fails on any change, `none` never fails
+ * `--threshold=N`   | ignore changes whose magnitude is at most N (default 0)
+ *
+ * Exit status is 0 when the gate passes, 1 when it fails and 2 on usage or
+ * input errors.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+  using Str   = std::string;
+  using Key   = std::tuple<Str,Str,Str>; //< { site, label, event }
+  using Tally = std::map<Key,long long>;
+
+  //----------------------------------------------------------------------------
+  // Map a raw Noisy event onto the summary categories it contributes to
+  std::vector<Str> categories( const Str& event )
+  {
+    static const std::map<Str,std::vector<Str>> table{
+      { "default-constructed", { "constructions" } },
+      { "explict-constructed", { "constructions" } },
+      { "copy-constructed",    { "constructions", "copies" } },
+      { "move-constructed",    { "constructions", "moves" } },
+      { "copy-assigned",       { "copies" } },
+      { "move-assigned",       { "moves" } },
+      { "deconstructed",       { "destructions" } },
+    };
+    if( auto it = table.find( event ); it != table.end() ) return it->second;
+    if( event.rfind( "alloc", 0 ) == 0 ) return { "allocations" };
+    return {}; //< e.g. self-assignment, comparisons, bytes-*
+  }
+
+  //----------------------------------------------------------------------------
+  // Quote labels only when needed so that common output stays readable
+  Str quote( const Str& label )
+  {
+    if( label.find_first_of( " \t\"\\" ) == Str::npos ) return label;
+    std::ostringstream os;
+    os << std::quoted( label );
+    return os.str();
+  }
+
+  //----------------------------------------------------------------------------
+  bool load( const Str& filename, Tally& tally )
+  {
+    std::ifstream is{ filename };
+    if( not is ) {
+      std::cerr << "Error: unable to read " << filename << std::endl;
+      return false;
+    }
+    Tally report, trace;
+    Str site{};
+    Str line;
+    while( std::getline( is, line ) ) {
+      // Count report entry
+      if( line.rfind( "Noisy-count ", 0 ) == 0 ) {
+        std::istringstream fields{ line.substr( 12 ) };
+        Str label, event;
+        long long count = 0;
+        if( fields >> std::quoted( label ) >> event >> count ) report[ { "", label, event } ] += count;
+        continue;
+      }
+      // Call site marker from DO(...) or ECHO(...); checked before trace entries
+      // because the echoed statement may itself contain "Noisy{ "
+      if( auto colon = line.find( ": " ); colon != Str::npos and colon > 0
+          and std::all_of( line.begin(), line.begin() + colon,
+                         []( unsigned char c ) { return std::isdigit( c ); } ) ) {
+        site = "line " + line.substr( 0, colon );
+        continue;
+      }
+      // Trace entry: Noisy{ ADDRESS: LABEL [ID] EVENT }
+      if( auto pos = line.find( "Noisy{ " ); pos != Str::npos ) {
+        std::istringstream fields{ line.substr( pos + 7 ) };
+        Str address, label;
+        std::vector<Str> tokens; //< [ID] EVENT
+        if( not ( fields >> address >> std::quoted( label ) ) ) continue;
+        for( Str token; fields >> token and token != "}"; ) tokens.push_back( token );
+        if( not tokens.empty() ) ++trace[ { site, label, tokens.back() } ];
+        continue;
+      }
+    }
+    tally = trace.empty() ? report : trace;
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  struct Row {
+    Str       name;
+    long long before{ 0 };
+    long long after{ 0 };
+    long long delta() const { return after - before; }
+  };
+
+  //............................................................................
+  void rank( std::vector<Row>& rows )
+  {
+    std::stable_sort( rows.begin(), rows.end(), []( const Row& lhs, const Row& rhs ) {
+      return std::llabs( lhs.delta() ) > std::llabs( rhs.delta() );
+    } );
+  }
+
+  //............................................................................
+  void show( const Str& title, const std::vector<Row>& rows, long long threshold )
+  {
+    std::cout << title << '\n';
+    std::cout << std::setw( 10 ) << "before" << std::setw( 10 ) << "after"
+              << std::setw( 10 ) << "delta" << "  what\n";
+    size_t shown = 0;
+    for( const auto& row : rows ) {
+      if( std::llabs( row.delta() ) <= threshold ) continue;
+      std::cout << std::setw( 10 ) << row.before << std::setw( 10 ) << row.after
+                << std::setw( 10 ) << std::showpos << row.delta() << std::noshowpos
+                << "  " << row.name << '\n';
+      ++shown;
+    }
+    if( shown == 0 ) std::cout << "  (no changes)\n";
+    std::cout << '\n';
+  }
+
+  //............................................................................
+  [[noreturn]] void usage( const char* program )
+  {
+    std::cerr << "Usage: " << program
+              << " [--fail-on=increase|any|none] [--threshold=N] BEFORE AFTER" << std::endl;
+    std::exit( 2 );
+  }
+
+}//endnamespace
+
+int main( int argc, char* argv[] )
+{
+  Str       fail_on{ "increase" };
+  long long threshold{ 0 };
+  std::vector<Str> files;
+  for( int i = 1; i < argc; ++i ) {
+    Str arg{ argv[i] };
+    if( arg.rfind( "--fail-on=", 0 ) == 0 ) {
+      fail_on = arg.substr( 10 );
+      if( fail_on != "increase" and fail_on != "any" and fail_on != "none" ) usage( argv[0] );
+    } else if( arg.rfind( "--threshold=", 0 ) == 0 ) {
+      try { threshold = std::stoll( arg.substr( 12 ) ); } catch( ... ) { usage( argv[0] ); }
+    } else if( arg.rfind( "--", 0 ) == 0 ) {
+      usage( argv[0] );
+    } else {
+      files.push_back( arg );
+    }
+  }
+  if( files.size() != 2 ) usage( argv[0] );
+
+  Tally before, after;
+  if( not load( files[0], before ) or not load( files[1], after ) ) return 2;
+
+  // Merge both sides into per-event and per-category rows
+  std::map<Key,Row> events;
+  std::map<std::pair<Str,Str>,Row> totals;  //< { label, event } regardless of call site
+  std::map<std::pair<Str,Str>,Row> summary;
+  auto merge = [&]( const Tally& tally, long long Row::* side ) {
+    for( const auto& [ key, count ] : tally ) {
+      const auto& [ site, label, event ] = key;
+      events[ key ].*side += count;
+      totals[ { label, event } ].*side += count;
+      for( const auto& category : categories( event ) ) summary[ { label, category } ].*side += count;
+    }
+  };
+  merge( before, &Row::before );
+  merge( after,  &Row::after  );
+
+  std::vector<Row> event_rows, summary_rows;
+  for( auto& [ key, row ] : events ) {
+    const auto& [ site, label, event ] = key;
+    std::ostringstream name;
+    if( not site.empty() ) name << site << ' ';
+    name << quote( label ) << ' ' << event;
+    row.name = name.str();
+    event_rows.push_back( row );
+  }
+  for( auto& [ key, row ] : summary ) {
+    row.name = quote( key.first ) + " " + key.second;
+    summary_rows.push_back( row );
+  }
+  rank( summary_rows );
+  rank( event_rows );
+  show( "Per-label summary:", summary_rows, threshold );
+  show( "Per-event detail:", event_rows, threshold );
+
+  // Gate on per-label event totals: call sites are display only, since any edit
+  // that shifts source lines would otherwise turn every event into a removal
+  // plus an addition. Raw events rather than categories so nothing is hidden
+  // by category overlap.
+  bool failed = false;
+  for( const auto& [ key, row ] : totals ) {
+    if( std::llabs( row.delta() ) <= threshold ) continue;
+    if( fail_on == "any" or ( fail_on == "increase" and row.delta() > 0 ) ) failed = true;
+  }
+  std::cout << ( failed ? "FAIL" : "PASS" ) << std::endl;
+  return failed ? 1 : 0;
+}
+
+//TAF! vim:nospell
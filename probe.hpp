@@ -0,0 +1,258 @@
+#pragma once
+
+/** @brief Hardware and software performance counters for scoped regions
+ *
+ * `PROBE( "name" );` measures from that point to the end of the enclosing scope
+ * and aggregates the results under the given region name. Use it next to
+ * `DEBUG`/`EXPECT` or around `DO(...)` statements:
+ *
+ *   {
+ *     PROBE_COUNTS( "fill", Noisy );
+ *     DO( v3.push_back( d5 ); )
+ *   }
+ *   Probe_base::report();
+ *
+ * Counters are read with Linux `perf_event_open` for the calling thread only.
+ * Hardware counters exclude the kernel, so the default `perf_event_paranoid`
+ * level suffices. Software counters include it when allowed, since page faults
+ * and context switches are kernel events. If the kernel refuses that,
+ * context switches come from `getrusage( RUSAGE_THREAD )` instead:
+ *
+ * Counter          | Kind
+ * -------          | ----
+ * cycles           | hardware
+ * instructions     | hardware
+ * cache-misses     | hardware
+ * branch-misses    | hardware
+ * page-faults      | software
+ * context-switches | software
+ *
+ * Any counter that cannot be opened (containers, VMs, non-Linux builds) is
+ * reported as `n/a` rather than failing. `PROBE_COUNTS( "name", T )` also
+ * records the change in `T::counts().copies` and `.moves` (e.g. `Noisy` or
+ * `Tracked<U>`) so copy-heavy regions can be compared with their cache cost.
+ */
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#if defined( __linux__ )
+#  include <linux/perf_event.h>
+#  include <sys/resource.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#  include <cstring>
+#endif
+
+//------------------------------------------------------------------------------
+// Default for PROBE(): no copy/move counts
+struct Probe_none
+{
+  struct Counts { size_t copies{0}, moves{0}; };
+  static Counts& counts() { static Counts none; return none; }
+};
+
+//------------------------------------------------------------------------------
+class Probe_base
+{
+public:
+  using Str   = std::string;
+  using Clock = std::chrono::steady_clock;
+  enum Counter { Cycles, Instructions, CacheMisses, BranchMisses, PageFaults, ContextSwitches, Counters_max };
+  using Values = std::array<uint64_t,Counters_max>;
+  using Mask   = std::array<bool,Counters_max>;
+  struct Sample { uint64_t value{0}, enabled{0}, running{0}; }; //< raw perf read
+  using Samples = std::array<Sample,Counters_max>;
+  struct Region {
+    size_t calls{0};
+    double seconds{0.0};
+    Values totals{};
+    Mask   available{};
+    size_t copies{0};
+    size_t moves{0};
+  };
+  using Registry = std::map<Str,Region>;
+  //............................................................................
+  static const char* name( Counter counter )
+  {
+    switch( counter ) {
+      case Cycles:          return "cycles";
+      case Instructions:    return "instructions";
+      case CacheMisses:     return "cache-misses";
+      case BranchMisses:    return "branch-misses";
+      case PageFaults:      return "page-faults";
+      case ContextSwitches: return "context-switches";
+      default:              return "?";
+    }
+  }
+  //............................................................................
+  static Registry&   registry() { static Registry regions; return regions; }
+  static std::mutex& guard()    { static std::mutex m; return m; }
+  //............................................................................
+  [[maybe_unused]] static void report( std::ostream& os = std::cout )
+  {
+    std::lock_guard<std::mutex> lock{ guard() };
+    os << std::setw( 8 ) << "calls" << std::setw( 12 ) << "seconds";
+    for( int c = 0; c < Counters_max; ++c ) os << std::setw( 18 ) << name( Counter( c ) );
+    os << std::setw( 10 ) << "copies" << std::setw( 10 ) << "moves" << "  region\n";
+    for( const auto& [ region, r ] : registry() ) {
+      os << std::setw( 8 ) << r.calls
+         << std::setw( 12 ) << std::fixed << std::setprecision( 6 ) << r.seconds << std::defaultfloat;
+      for( int c = 0; c < Counters_max; ++c ) {
+        if( r.available[c] ) os << std::setw( 18 ) << r.totals[c];
+        else                 os << std::setw( 18 ) << "n/a";
+      }
+      os << std::setw( 10 ) << r.copies << std::setw( 10 ) << r.moves << "  " << region << '\n';
+    }
+    os << std::flush;
+  }
+
+//------------------------------------------------------------------------------
+protected:
+  // Per-thread counter file descriptors, opened once and left running
+  class Counters
+  {
+  public:
+    Counters()
+    {
+      m_fd.fill( -1 );
+#if defined( __linux__ )
+      const std::array<std::pair<uint32_t,uint64_t>,Counters_max> config{ {
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+        { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+        { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+      } };
+      for( int c = 0; c < Counters_max; ++c ) {
+        perf_event_attr attr;
+        std::memset( &attr, 0, sizeof( attr ) );
+        attr.size           = sizeof( attr );
+        attr.type           = config[c].first;
+        attr.config         = config[c].second;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        bool software = ( attr.type == PERF_TYPE_SOFTWARE );
+        if( software ) {
+          attr.exclude_kernel = 0;
+          m_fd[c] = open( attr );
+          if( m_fd[c] >= 0 ) continue;
+          attr.exclude_kernel = 1; //< restricted by perf_event_paranoid
+        }
+        if( software and c == ContextSwitches ) continue; //< always 0 from user space
+        m_fd[c] = open( attr );
+      }
+#endif
+    }
+    ~Counters()
+    {
+#if defined( __linux__ )
+      for( auto fd : m_fd ) if( fd >= 0 ) close( fd );
+#endif
+    }
+    Counters( const Counters& ) = delete;
+    Counters& operator=( const Counters& ) = delete;
+    //..........................................................................
+    // Current raw values; unavailable counters read as zero
+    Samples read( Mask& available ) const noexcept
+    {
+      Samples samples{};
+      available.fill( false );
+#if defined( __linux__ )
+      for( int c = 0; c < Counters_max; ++c ) {
+        uint64_t data[3]{}; //< value, time enabled, time running
+        if( m_fd[c] < 0 or ::read( m_fd[c], data, sizeof( data ) ) != ssize_t( sizeof( data ) ) ) continue;
+        samples[c] = { data[0], data[1], data[2] };
+        available[c] = true;
+      }
+      struct rusage usage;
+      if( m_fd[ContextSwitches] < 0 and getrusage( RUSAGE_THREAD, &usage ) == 0 ) {
+        samples[ContextSwitches] = { uint64_t( usage.ru_nvcsw + usage.ru_nivcsw ), 0, 0 }; //< never scaled
+        available[ContextSwitches] = true;
+      }
+#endif
+      return samples;
+    }
+  private:
+    std::array<int,Counters_max> m_fd{};
+#if defined( __linux__ )
+    static int open( perf_event_attr& attr ) noexcept
+    {
+      return int( syscall( SYS_perf_event_open, &attr, 0, -1, -1, 0 ) );
+    }
+#endif
+  };
+  //............................................................................
+  static Counters& counters() { thread_local Counters per_thread; return per_thread; }
+  //............................................................................
+  // Change between two samples, scaled for multiplexing over that interval only
+  static uint64_t delta( const Sample& start, const Sample& end ) noexcept
+  {
+    auto diff = []( uint64_t a, uint64_t b ) { return ( b > a ) ? b - a : uint64_t( 0 ); };
+    uint64_t value   = diff( start.value,   end.value   );
+    uint64_t enabled = diff( start.enabled, end.enabled );
+    uint64_t running = diff( start.running, end.running );
+    if( running == 0 or running >= enabled ) return value;
+    return uint64_t( double( value ) * double( enabled ) / double( running ) );
+  }
+};
+
+//------------------------------------------------------------------------------
+template<class Counted = Probe_none>
+class Probe: public Probe_base
+{
+public:
+  explicit Probe( Str region )
+  : m_region( std::move( region ) )
+  , m_copies( Counted::counts().copies )
+  , m_moves( Counted::counts().moves )
+  , m_samples( counters().read( m_available ) ) //< opens this thread's counters on first use
+  , m_start( Clock::now() )
+  {
+  }
+  //............................................................................
+  ~Probe()
+  {
+    auto seconds = std::chrono::duration<double>( Clock::now() - m_start ).count();
+    Mask available{};
+    auto samples = counters().read( available );
+    auto copies  = Counted::counts().copies - m_copies;
+    auto moves   = Counted::counts().moves  - m_moves;
+    std::lock_guard<std::mutex> lock{ guard() };
+    auto& r = registry()[ m_region ];
+    ++r.calls;
+    r.seconds += seconds;
+    for( int c = 0; c < Counters_max; ++c ) {
+      r.available[c] = ( r.calls == 1 or r.available[c] ) and available[c] and m_available[c];
+      if( r.available[c] ) r.totals[c] += delta( m_samples[c], samples[c] );
+    }
+    r.copies += copies;
+    r.moves  += moves;
+  }
+  Probe( const Probe& ) = delete;
+  Probe& operator=( const Probe& ) = delete;
+
+//------------------------------------------------------------------------------
+private:
+  Str               m_region;
+  size_t            m_copies;
+  size_t            m_moves;
+  Mask              m_available{};
+  Samples           m_samples;
+  Clock::time_point m_start;
+};
+
+#define PROBE_CONCAT_(a,b) a##b
+#define PROBE_CONCAT(a,b)  PROBE_CONCAT_(a,b)
+#define PROBE(region)            Probe<> PROBE_CONCAT(probe_,__LINE__){ region }
+#define PROBE_COUNTS(region,type) Probe<type> PROBE_CONCAT(probe_,__LINE__){ region }
+
+//TAF! vim:nospell
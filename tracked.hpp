@@ -0,0 +1,272 @@
+#pragma once
+
+/** @brief Track bytes deep-copied versus moved for any value type
+ *
+ * `Noisy` counts events, but a copy of an 8-byte handle looks the same as a
+ * copy of a 50 MB vector. Wrap a value in `Tracked<T>` to record the same
+ * events along with the logical number of bytes each one copied or moved.
+ * Unlike `Noisy`, nothing is printed per event, so it can stay in place while
+ * measuring throughput.
+ *
+ * The logical size of a value comes from `TrackedSize<T>`. The default is
+ * `sizeof(T)` plus `size() * sizeof(value_type)` for heap-owning containers
+ * (e.g. `std::vector<int>`, `std::string`), and plain `sizeof(T)` for
+ * everything else, including containers that store elements inline
+ * (`std::array`, detected via `std::tuple_size`). Nested containers are counted
+ * shallowly: a `std::vector<std::string>` counts `sizeof(std::string)` per
+ * element, not the characters. Specialize it for your own types:
+ *
+ *   template<> struct TrackedSize<Image> {
+ *     size_t operator()( const Image& i ) const { return sizeof(i) + i.bytes(); }
+ *   };
+ *
+ * Statistics are kept per label, which defaults to the (demangled) type name
+ * and may be changed with `Tracked<T>::label("name")` before first use. Each
+ * type binds to its statistics once, so an event costs a few relaxed atomic
+ * increments plus the size function. Objects may be created, moved and
+ * destroyed on any thread; binding, `reset()` and `report()` are serialized
+ * by `Tracked_base::guard()`.
+ *
+ * `Tracked_base::report()` ranks labels by bytes copied per second over one
+ * shared window (from the first tracked event, or the last
+ * `Tracked_base::reset()`) and also emits `Noisy-count` lines for `noisydiff`.
+ *
+ * Events and running totals come from `Noisy_events` (noisy_events.hpp), the
+ * same vocabulary `Noisy` uses, so `Expect::Budget<Tracked<T>>` works for
+ * copy/move budgets and reports from both line up.
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+#include "noisy_events.hpp"
+#if __has_include(<cxxabi.h>)
+#  include <cxxabi.h>
+#  include <cstdlib>
+#endif
+
+//------------------------------------------------------------------------------
+// Logical size of a value; specialize for your own types
+template<class T, class = void>
+struct TrackedSize
+{
+  size_t operator()( const T& ) const noexcept { return sizeof( T ); }
+};
+
+// Containers with a compile-time size (std::array) hold their elements inline
+template<class T, class = void>
+struct Tracked_is_inline : std::false_type {};
+template<class T>
+struct Tracked_is_inline<T, std::void_t<decltype( std::tuple_size<T>::value )>> : std::true_type {};
+
+template<class T>
+struct TrackedSize<T, std::enable_if_t<not Tracked_is_inline<T>::value,
+                      std::void_t<typename T::value_type, decltype( std::declval<const T&>().size() )>>>
+{
+  size_t operator()( const T& v ) const noexcept { return sizeof( T ) + v.size() * sizeof( typename T::value_type ); }
+};
+
+//------------------------------------------------------------------------------
+class Tracked_base: public Noisy_events
+{
+public:
+  using Str   = std::string;
+  using Clock = std::chrono::steady_clock;
+  using Count = std::atomic<size_t>;
+  struct Stats {
+    std::array<Count,States_max> events{};
+    Count                        bytes_copied{0};
+    Count                        bytes_moved{0};
+  };
+  using Registry = std::map<Str,Stats>;
+  //............................................................................
+  static Registry&          registry() { static Registry stats; return stats; }
+  static std::mutex&        guard()    { static std::mutex m; return m; }
+  static Clock::time_point& epoch()    { static Clock::time_point start{ Clock::now() }; return start; }
+  //............................................................................
+  // Start a new measurement window for all labels
+  [[maybe_unused]] static void reset()
+  {
+    std::lock_guard<std::mutex> lock{ guard() };
+    for( auto& entry : registry() ) { //< keep nodes; Tracked<T> caches them
+      for( auto& count : entry.second.events ) count = 0;
+      entry.second.bytes_copied = 0;
+      entry.second.bytes_moved  = 0;
+    }
+    epoch() = Clock::now();
+  }
+  //............................................................................
+  [[maybe_unused]] static void report( std::ostream& os = std::cout )
+  {
+    std::lock_guard<std::mutex> lock{ guard() };
+    struct Row { Str label; const Stats* stats; double rate; };
+    std::vector<Row> rows;
+    double seconds = std::chrono::duration<double>( Clock::now() - epoch() ).count();
+    for( const auto& [ label, stats ] : registry() ) {
+      double rate = ( seconds > 0.0 ) ? double( stats.bytes_copied ) / seconds : 0.0;
+      rows.push_back( { label, &stats, rate } );
+    }
+    std::stable_sort( rows.begin(), rows.end(), []( const Row& lhs, const Row& rhs ) {
+      return lhs.rate > rhs.rate;
+    } );
+    os << "Window: " << std::fixed << std::setprecision( 3 ) << seconds << " seconds\n";
+    os << std::setw( 14 ) << "copied-B/s"
+       << std::setw( 14 ) << "bytes-copied"
+       << std::setw( 14 ) << "bytes-moved"
+       << "  label\n";
+    for( const auto& row : rows ) {
+      os << std::setw( 14 ) << std::setprecision( 0 ) << row.rate
+         << std::setw( 14 ) << row.stats->bytes_copied
+         << std::setw( 14 ) << row.stats->bytes_moved
+         << "  " << quote( row.label ) << '\n';
+    }
+    os << std::defaultfloat;
+    for( const auto& [ label, stats ] : registry() ) {
+      for( int e = 0; e < States_max; ++e ) {
+        if( stats.events[e] == 0 ) continue;
+        os << "Noisy-count " << quote( label ) << ' ' << event_name( State_t( e ) ) << ' ' << stats.events[e] << '\n';
+      }
+      os << "Noisy-count " << quote( label ) << " bytes-copied " << stats.bytes_copied << '\n';
+      os << "Noisy-count " << quote( label ) << " bytes-moved "  << stats.bytes_moved  << '\n';
+    }
+    os << std::flush;
+  }
+  //............................................................................
+  // Readable type names for default labels
+  static Str demangle( const char* name )
+  {
+#if __has_include(<cxxabi.h>)
+    int status = 0;
+    char* readable = abi::__cxa_demangle( name, nullptr, nullptr, &status );
+    if( status == 0 and readable != nullptr ) {
+      Str result{ readable };
+      std::free( readable );
+      // Labels are whitespace-free so reports stay easy to parse
+      result.erase( std::remove( result.begin(), result.end(), ' ' ), result.end() );
+      return result;
+    }
+#endif
+    return name;
+  }
+};
+
+//------------------------------------------------------------------------------
+template<class T, class Size = TrackedSize<T>>
+class Tracked: public Tracked_base
+{
+public:
+  //----------------------------------------------------------------------------
+  // Constructors and other special members
+  Tracked()                              //< default-constructor
+  : m_value()
+  {
+    record( DfltCtor );
+  }
+  //............................................................................
+  explicit Tracked( T value )            //< explicit-constructor (takes ownership)
+  : m_value( std::move( value ) )
+  {
+    record( ExplCtor );
+  }
+  //............................................................................
+  ~Tracked()                             //< destructor
+  {
+    record( Dtor );
+  }
+  //............................................................................
+  Tracked( const Tracked& rhs )          //< copy-constructor
+  : m_value( rhs.m_value )
+  {
+    stats().bytes_copied.fetch_add( Size{}( m_value ), std::memory_order_relaxed );
+    record( CpCtor );
+  }
+  //............................................................................
+  Tracked& operator=( const Tracked& rhs ) //< copy-assign
+  {
+    if( this != &rhs ) {
+      m_value = rhs.m_value;
+      stats().bytes_copied.fetch_add( Size{}( m_value ), std::memory_order_relaxed );
+      record( CpAsgn );
+    } else {
+      record( CpSelf );
+    }
+    return *this;
+  }
+  //............................................................................
+  Tracked( Tracked&& rhs ) noexcept( std::is_nothrow_move_constructible_v<T> ) //< move-constructor
+  : m_value( std::move( rhs.m_value ) )
+  {
+    stats().bytes_moved.fetch_add( Size{}( m_value ), std::memory_order_relaxed );
+    record( MvCtor );
+  }
+  //............................................................................
+  Tracked& operator=( Tracked&& rhs ) noexcept( std::is_nothrow_move_assignable_v<T> ) //< move-assign
+  {
+    if( this != &rhs ) {
+      m_value = std::move( rhs.m_value );
+      stats().bytes_moved.fetch_add( Size{}( m_value ), std::memory_order_relaxed );
+      record( MvAsgn );
+    } else {
+      record( MvSelf );
+    }
+    return *this;
+  }
+  //----------------------------------------------------------------------------
+  // Accessors
+  //............................................................................
+  [[nodiscard]] T&       get()              noexcept { return m_value; }
+  [[nodiscard]] const T& get()        const noexcept { return m_value; }
+  T&                     operator*()        noexcept { return m_value; }
+  const T&               operator*()  const noexcept { return m_value; }
+  T*                     operator->()       noexcept { return &m_value; }
+  const T*               operator->() const noexcept { return &m_value; }
+  //............................................................................
+  static Atomic_counts& counts() { static Atomic_counts totals; return totals; }
+  static Stats& stats()
+  {
+    auto* cached = s_stats.load( std::memory_order_acquire );
+    return cached ? *cached : bind();
+  }
+  //............................................................................
+  static Str label() { std::lock_guard<std::mutex> lock{ guard() }; return name(); }
+  [[maybe_unused]] static void label( const Str& s )
+  {
+    std::lock_guard<std::mutex> lock{ guard() };
+    name() = s;
+    s_stats.store( &registry()[ s ], std::memory_order_release );
+  }
+
+//------------------------------------------------------------------------------
+private:
+  T m_value;
+  inline static std::atomic<Stats*> s_stats{ nullptr }; //< cached registry entry for this type
+  static Str& name() { static Str s{ demangle( typeid( T ).name() ) }; return s; }
+  static Stats& bind()
+  {
+    std::lock_guard<std::mutex> lock{ guard() };
+    epoch();
+    if( auto* cached = s_stats.load( std::memory_order_acquire ) ) return *cached;
+    auto* entry = &registry()[ name() ];
+    s_stats.store( entry, std::memory_order_release );
+    return *entry;
+  }
+  static void record( State_t event )
+  {
+    stats().events[ event ].fetch_add( 1, std::memory_order_relaxed );
+    tick( counts(), event );
+  }
+};
+
+//TAF! vim:nospell
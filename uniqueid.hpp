@@ -14,12 +14,34 @@
 
  Moving is not worth the effort.
 
+ Each id also records the path of threads that owned or touched it: the
+ constructing thread, each thread that took ownership, and any thread that
+ called `touch()` (e.g. to note a copy from it). Consecutive repeats are
+ collapsed, so `threads().size() - 1` is the number of migrations. Threads are
+ recorded by a per-thread serial number (`UniqueId_base::this_thread()`)
+ rather than `std::thread::id`, which the runtime reuses once a thread is
+ joined. The thread path is not synchronized; owners that share ids across
+ threads (e.g. Noisy) must serialize `touch()` and friends themselves.
+
 */
 
+#include <atomic>
 #include <cstddef>
 #include <string>
 #include <stdexcept>
-class UniqueId_base {};
+#include <utility>
+#include <vector>
+class UniqueId_base
+{
+public:
+  // Serial number of the calling thread, never reused within a process
+  static size_t this_thread() noexcept
+  {
+    static std::atomic<size_t> next{0};
+    thread_local size_t serial{ next++ };
+    return serial;
+  }
+};
 
 template<class T, size_t start=0u>
 class UniqueId: public UniqueId_base
@@ -27,10 +49,12 @@ class UniqueId: public UniqueId_base
 public:
   using Error = std::runtime_error;
   using UniqueId_ptr = UniqueId_base*;
+  using Threads = std::vector<size_t>; //< this_thread() serials
   //............................................................................
   explicit UniqueId(const std::string& prefix="")
   : m_id(s_next())
   , m_self(new UniqueId_ptr)
+  , m_threads{ this_thread() }
   {
     *m_self = this;
     if( m_id == start ) s_prefix = prefix;
@@ -44,9 +68,11 @@ public:
   UniqueId( const UniqueId& rhs )
   : m_id( rhs.m_id )
   , m_self( rhs.m_self )
+  , m_threads( std::exchange( rhs.m_threads, Threads{} ) )
   {
     *m_self = this; //< become owner
     rhs.m_self = nullptr;
+    touch();
   }
 
   //............................................................................
@@ -58,6 +84,8 @@ public:
       m_self  = rhs.m_self;
       *m_self = this; //< become owner
       rhs.m_self = nullptr;
+      m_threads = std::exchange( rhs.m_threads, Threads{} );
+      touch();
     }
     return *this;
   }
@@ -99,11 +127,29 @@ public:
   //............................................................................
   size_t operator()(bool check=true) const { return id(check); }
 
+  //............................................................................
+  // Thread history of this id
+  const Threads& threads() const noexcept { return m_threads; }
+  void touch() const
+  {
+    auto self = this_thread();
+    if( m_threads.empty() or m_threads.back() != self ) m_threads.push_back( self );
+  }
+  // Continue the thread path of rhs (e.g. when its value is moved in), leaving rhs without one
+  void take_threads( const UniqueId& rhs )
+  {
+    m_threads = std::exchange( rhs.m_threads, Threads{} );
+    touch();
+  }
+  // Begin a new thread path here (e.g. when a fresh copy is assigned in)
+  void restart_threads() { m_threads = Threads{ this_thread() }; }
+
 private:
   size_t m_id;
   mutable UniqueId_ptr* m_self{nullptr};
+  mutable Threads m_threads{};
   inline static std::string s_prefix = "";
-  size_t s_next() const { static size_t id=start; return id++; }
+  size_t s_next() const { static std::atomic<size_t> id{start}; return id++; }
 };
 
 //TAF! vim:nospell
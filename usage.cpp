@@ -6,11 +6,24 @@
 #if defined( UNIQUEID_SELFTEST)
   #include "uniqueid.hpp"
 #endif
+#if defined( TRACKED_SELFTEST ) || defined( PROBE_SELFTEST )
+  #include "tracked.hpp"
+#endif
+#if defined( PROBE_SELFTEST )
+  #include "probe.hpp"
+#endif
 #include "print.hpp"
 #include "to_string.hpp"
 #include "expect.hpp"
 #include <array>
 #include <iostream>
+#if defined( EXPECT_SELFTEST )
+  #include <algorithm>
+  #include <chrono>
+  #include <cstdint>
+  #include <type_traits>
+#endif
+#include <thread>
 using namespace std::literals;
 
 // A few simple classes illustrating usage
@@ -49,14 +62,80 @@ private:
   static int nextid() { static int i; return i++; }
 };
 
+#if defined( NOISY2_SELFTEST )
+// Helpers for copy/move budget tests
+Noisy make_rvo()  { return Noisy{ "rvo" }; }
+Noisy make_nrvo() { Noisy result{ "nrvo" }; result.info(); return result; }
+#endif
+
+#if defined( TRACKED_SELFTEST )
+// A user struct with a custom logical size
+struct Record
+{
+  std::string name;
+  std::vector<double> samples;
+};
+template<> struct TrackedSize<Record>
+{
+  size_t operator()( const Record& r ) const noexcept
+  {
+    return sizeof( r ) + r.name.size() + r.samples.size() * sizeof( double );
+  }
+};
+#endif
+
 #include <vector>
 int main()
 {
 
 ////////////////////////////////////////////////////////////////////////////////
 #ifdef EXPECT_SELFTEST
+  __________;
+  INFO( "Test Expect macros" );
+  __________;
+  {
+    // Deferred failures from several threads
+    auto errors = Expect::errors();
+    auto worker = []{ for( int i = 0; i < 1'000; ++i ) EXPECT_HOT( i % 100 != 0 ); };
+    std::thread t1{ worker };
+    std::thread t2{ worker };
+    t1.join();
+    t2.join();
+    EXPECT( Expect::errors() == errors ); //< nothing reported until flushed
+    EXPECT( Expect::hot_flush() == 20 );
+    EXPECT( Expect::errors() == errors + 20 );
+    EXPECT( Expect::hot_flush() == 0 );
+    Expect::errors() = errors;
 
-#endif
+    // Microbenchmark: loop cost with and without EXPECT_HOT (best of several runs)
+    const uint64_t iterations = 100'000'000u;
+    volatile uint64_t limit = uint64_t( 1 ) << 24;
+    volatile uint64_t sink  = 0;
+    auto run = [&]( auto check ) { //< check is std::true_type or std::false_type
+      auto start = std::chrono::steady_clock::now();
+      uint64_t x = 1, sum = 0;
+      const uint64_t bound = limit;
+      for( uint64_t i = 0; i < iterations; ++i ) {
+        x = x * 6364136223846793005u + 1442695040888963407u;
+        sum += x >> 33;
+        if constexpr( decltype( check )::value ) EXPECT_HOT( ( x >> 40 ) < bound );
+      }
+      sink = sum;
+      return std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+    };
+    double plain = 1e9, checked = 1e9;
+    for( int repeat = 0; repeat < 5; ++repeat ) {
+      plain   = std::min( plain,   run( std::false_type{} ) );
+      checked = std::min( checked, run( std::true_type{} ) );
+    }
+    SHOW( plain );
+    SHOW( checked );
+    SHOW( 100.0 * ( checked - plain ) / plain );
+    EXPECT( Expect::hot_flush() == 0 );
+  }
+  __________;
+  return Expect::summary( "Expect test" );
+#endif/*EXPECT_SELFTEST*/
 
 ////////////////////////////////////////////////////////////////////////////////
 #ifdef UNIQUEID_SELFTEST
@@ -132,6 +211,19 @@ int main()
       SHOW( composed.shared() );
     }
 
+    // Thread history follows ownership
+    UniqueId<char> traveller;
+    std::thread{ [&traveller]{
+      UniqueId<char> arrived{ traveller };
+      EXPECT( arrived.threads().size() == 2 );
+      EXPECT( arrived.threads().back() == UniqueId_base::this_thread() );
+    } }.join();
+    EXPECT( traveller.threads().empty() );
+    size_t first = 0, second = 0;
+    std::thread{ [&first]{ first = UniqueId_base::this_thread(); } }.join();
+    std::thread{ [&second]{ second = UniqueId_base::this_thread(); } }.join();
+    EXPECT( first != second ); //< std::thread::id may be reused after join
+
     #if defined( BAD3 ) || defined( BADALL )
     SHOW( carray[0]() ); //< Did not define operator() -- works implicitly only if inherited
     #endif
@@ -142,6 +234,112 @@ int main()
   return Expect::summary("UniqId test");
 #endif/*UNIQUEID_SELFTEST*/
 
+////////////////////////////////////////////////////////////////////////////////
+#ifdef TRACKED_SELFTEST
+  __________;
+  INFO( "Test Tracked class" );
+  __________;
+  {
+    using Big = Tracked<std::vector<int>>;
+    Big::label( "vector<int>" );
+    Tracked<std::string>::label( "string" );
+    Tracked<Record>::label( "Record" );
+
+    DO( Big b1{ std::vector<int>( 1'000'000 ) }; )
+    const size_t bytes = sizeof( std::vector<int> ) + 1'000'000 * sizeof( int );
+    EXPECT( Big::stats().bytes_copied == 0 );
+    DO( Big b2{ b1 }; )
+    EXPECT( Big::stats().bytes_copied == bytes );
+    DO( Big b3{ std::move( b2 ) }; )
+    EXPECT( Big::stats().bytes_moved == bytes );
+    EXPECT( b2->empty() and b3->size() == 1'000'000 );
+    {
+      Expect::Budget<Big> budget{ Expect::Budget<Big>::Copies, Expect::Budget<Big>::AtMost, 0, __FILE__, __LINE__ };
+      DO( b2 = std::move( b3 ); )
+    }
+    EXPECT( Big::counts().copies == 1 and Big::counts().moves == 2 );
+
+    DO( Tracked<std::string> s1{ std::string( 100, 'x' ) }; )
+    DO( auto s2 = s1; )
+    EXPECT( Tracked<std::string>::stats().bytes_copied == sizeof( std::string ) + 100 );
+
+    ECHO( "Tracked<Record> r1{ Record{ \"abc\", std::vector<double>( 10 ) } };" );
+    Tracked<Record> r1{ Record{ "abc", std::vector<double>( 10 ) } };
+    DO( auto r2 = r1; )
+    EXPECT( Tracked<Record>::stats().bytes_copied == sizeof( Record ) + 3 + 10 * sizeof( double ) );
+    EXPECT( Tracked<Record>::stats().events[ Noisy_events::CpCtor ] == 1 );
+
+    // Inline containers are counted once, not as object plus elements
+    using Inline = Tracked<std::array<int,1000>>;
+    Inline::label( "array<int,1000>" );
+    DO( Inline a1{}; )
+    DO( auto a2 = a1; )
+    EXPECT( Inline::stats().bytes_copied == sizeof( std::array<int,1000> ) );
+
+    // Copies on several threads are all counted
+    ECHO( "4 threads x 1000 copies of s1" );
+    {
+      std::vector<std::thread> workers;
+      for( int t = 0; t < 4; ++t ) workers.emplace_back( [&s1] {
+        for( int i = 0; i < 1000; ++i ) { auto copy = s1; }
+      } );
+      for( auto& worker : workers ) worker.join();
+    }
+    EXPECT( Tracked<std::string>::counts().copies == 4001 );
+  }
+  BLANK_LINE;
+  INFO( "Bytes copied per second by label" );
+  Tracked_base::report();
+  __________;
+  return Expect::summary( "Tracked test" );
+#endif/*TRACKED_SELFTEST*/
+
+////////////////////////////////////////////////////////////////////////////////
+#ifdef PROBE_SELFTEST
+  __________;
+  INFO( "Test Probe class" );
+  __________;
+  {
+    using Big = Tracked<std::vector<int>>;
+    Big::label( "vector<int>" );
+    Big source{ std::vector<int>( 1'000'000, 1 ) };
+    std::vector<Big> sink;
+    sink.reserve( 20 );
+    for( int i = 0; i < 10; ++i ) {
+      PROBE_COUNTS( "copy-in", Big );
+      DO( sink.push_back( source ); )
+    }
+    for( int i = 0; i < 10; ++i ) {
+      Big temp{ std::vector<int>( 1'000'000, 2 ) };
+      PROBE_COUNTS( "move-in", Big );
+      DO( sink.push_back( std::move( temp ) ); )
+    }
+    {
+      PROBE( "plain" );
+      DO( sink.clear(); )
+    }
+    const auto& regions = Probe_base::registry();
+    EXPECT( regions.at( "copy-in" ).calls  == 10 );
+    EXPECT( regions.at( "copy-in" ).copies == 10 );
+    EXPECT( regions.at( "copy-in" ).moves  == 0  );
+    EXPECT( regions.at( "move-in" ).copies == 0  );
+    EXPECT( regions.at( "move-in" ).moves  == 10 );
+    EXPECT( regions.at( "plain" ).calls    == 1  );
+    {
+      PROBE( "sleep" );
+      DO( std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) ); )
+    }
+    // Voluntary switches are kernel events; they must not read as zero
+    const auto& sleep = regions.at( "sleep" );
+    EXPECT( not sleep.available[ Probe_base::ContextSwitches ] or sleep.totals[ Probe_base::ContextSwitches ] >= 1 );
+  }
+  BLANK_LINE;
+  INFO( "Counters by region (n/a where perf counters are unavailable)" );
+  Probe_base::report();
+  __________;
+  return Expect::summary( "Probe test" );
+#endif/*PROBE_SELFTEST*/
+
 ////////////////////////////////////////////////////////////////////////////////
 #if defined( NOISY1_SELFTEST ) || defined( NOISY2_SELFTEST )
   {
@@ -209,6 +407,93 @@ int main()
   }
 #endif/*NOISY1_SELFTEST||NOISY2_SELFTEST*/
 
+#if defined( NOISY2_SELFTEST )
+  {
+    BLANK_LINE;
+    __________;
+    INFO( "Copy/move budgets" );
+    __________;
+    {
+      EXPECT_NO_COPIES();
+      EXPECT_MOVES( 0 );
+      DO( auto r1 = make_rvo(); )
+      DO( auto r2 = make_nrvo(); )
+    }
+    {
+      std::vector<Noisy> v;
+      v.reserve( 2 );
+      EXPECT_NO_COPIES();
+      EXPECT_MOVES( 1 );
+      DO( v.emplace_back( "emplaced" ); )
+      DO( v.push_back( Noisy{ "pushed" } ); ) // NOLINT(modernize-use-emplace)
+    }
+    {
+      auto errors = Expect::errors();
+      {
+        EXPECT_MAX_COPIES( 1 );
+        DO( Noisy n1{ "copied" }; )
+        DO( Noisy n2{ n1 }; )
+        DO( Noisy n3{ n1 }; )
+      }
+      EXPECT( Expect::errors() == errors + 1 ); //< deliberately over budget
+      Expect::errors() = errors;
+    }
+  }
+  {
+    BLANK_LINE;
+    __________;
+    INFO( "Cross-thread migration" );
+    __________;
+    {
+      DO( Noisy local{ "local" }; )
+      DO( Noisy moved{ "piped" }; )
+      DO( Noisy copied{ "piped" }; )
+      DO( Noisy handed{ "piped" }; )
+      std::thread consumer{ [&moved, &copied, &handed]{
+        DO( Noisy taken{ std::move( moved ) }; )
+        DO( Noisy echo{ moved }; ) // NOLINT(bugprone-use-after-move)
+        DO( Noisy clone{ copied }; )
+        DO( Noisy slot; )
+        DO( slot = std::move( handed ); )
+      } };
+      consumer.join();
+      // Concurrent copies of one const object
+      const Noisy shared{ "shared" };
+      auto reader = [&shared]{ for( int i = 0; i < 3; ++i ) { Noisy c{ shared }; } };
+      std::thread r1{ reader };
+      std::thread r2{ reader };
+      r1.join();
+      r2.join();
+      // Swapping on another thread moves both values through husks and back
+      DO( Noisy left{ "swapped" }; )
+      DO( Noisy right{ "swapped" }; )
+      std::thread swapper{ [&left, &right]{
+        DO( std::swap( left, right ); )
+      } };
+      swapper.join();
+    }
+    const auto& piped = Noisy::migrations()[ "piped" ];
+    EXPECT( piped.objects   == 4 ); //< taken, clone, slot and copied (moved and handed are husks)
+    EXPECT( piped.migrated  == 3 ); //< T0->T1 twice and T0->T1->T0
+    EXPECT( piped.histogram.at( 0 ) == 1 );
+    EXPECT( piped.histogram.at( 1 ) == 2 );
+    EXPECT( piped.histogram.at( 2 ) == 1 );
+    EXPECT( Noisy::migrations()[ "local" ].migrated == 0 );
+    EXPECT( Noisy::migrations()[ "shared" ].objects == 7 );
+    const auto& swapped = Noisy::migrations()[ "swapped" ];
+    EXPECT( swapped.objects == 2 );
+    EXPECT( swapped.histogram.at( 2 ) == 2 ); //< T0->Tn->T0 for both values
+    EXPECT( Noisy::migrations()[ "<<empty>>" ].objects  == 1 ); //< echo only; husks are not counted
+    EXPECT( Noisy::migrations()[ "<<empty>>" ].migrated == 0 );
+    Noisy::migration_report();
+  }
+  __________;
+  INFO( "Noisy event counts (compare runs with noisydiff)" );
+  Noisy::report();
+  __________;
+  return Expect::summary( "Noisy test" );
+#endif/*NOISY2_SELFTEST*/
+
   __________;
   INFO("Done");
 return 0;